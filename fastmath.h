@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cmath>
+
+// Uncomment to trade exact divisions and square roots for hardware approximations.
+// #define FAST_MATH
+
+#ifdef FAST_MATH
+#include <xmmintrin.h>
+#endif
+
+// Maximum relative error of FAST_MATH helpers against the exact functions
+// over normal inputs (checked by tests/fast_math.cpp). Square roots take
+// positive inputs, reciprocal and divide inputs of both signs.
+// The bounds follow from the 1.5 * 2^-12 error of the SSE estimates
+// and the rounding of the Newton-Raphson step.
+#define RECIPROCAL_MAX_ERROR        2.6e-7  // for |x| < 2^126, larger values flush to 0
+#define DIVIDE_MAX_ERROR            3.2e-7  // same range of the divisor, normal quotients
+#define RECIPROCAL_SQRT_MAX_ERROR   3.8e-7
+#define SQUARE_ROOT_MAX_ERROR       4.4e-7
+
+// Math helpers used on the hot path.
+// With FAST_MATH the SSE estimates are refined by one Newton-Raphson step.
+// Without FAST_MATH the results are exact.
+
+// Calculate 1 / x.
+inline float reciprocal(float x)
+{
+#ifdef FAST_MATH
+    float r = _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss(x)));
+
+    return r * (2 - x * r);
+#else
+    return 1 / x;
+#endif
+}
+
+// Calculate x / y.
+inline float divide(float x, float y)
+{
+#ifdef FAST_MATH
+    return x * reciprocal(y);
+#else
+    return x / y;
+#endif
+}
+
+// Calculate 1 / sqrt(x).
+inline float reciprocalSqrt(float x)
+{
+#ifdef FAST_MATH
+    float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+
+    return r * (1.5f - 0.5f * x * r * r);
+#else
+    return 1 / std::sqrt(x);
+#endif
+}
+
+// Calculate sqrt(x).
+inline float squareRoot(float x)
+{
+#ifdef FAST_MATH
+    // The estimate of 1 / sqrt(0) is infinity.
+    if (x == 0) return 0;
+
+    return x * reciprocalSqrt(x);
+#else
+    return std::sqrt(x);
+#endif
+}
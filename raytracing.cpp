@@ -1,7 +1,19 @@
 #include "raytracing.h"
 
+// Background renderer of the window.
+Renderer renderer;
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow)
 {
+    // Run without a window if requested.
+    int requests, clients;
+
+    if (std::wcsncmp(pCmdLine, L"--server", 8) == 0)
+        return runServer(stdin, stdout);
+
+    if (std::swscanf(pCmdLine, L"--loadgen %d %d", &requests, &clients) == 2)
+        return runLoadGenerator(requests, clients, stdout);
+
     // Class creation and registration.
     WNDCLASS wc = { };
 
@@ -49,7 +61,28 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     switch (uMsg)
     {
+    case WM_CREATE:
+        // Repaint the window every time a frame is published.
+        renderer.start([hwnd] { PostMessage(hwnd, WM_FRAME_READY, 0, 0); });
+        return 0;
+
+    case WM_SIZE:
+    {
+        // Request a frame for the new dimensions.
+        Screen screen = measureWindow(hwnd);
+
+        if (screen.height != 0 || screen.width != 0)
+            renderer.request(screen, PIXEL_ORDER);
+
+        return 0;
+    }
+
+    case WM_FRAME_READY:
+        InvalidateRect(hwnd, NULL, FALSE);
+        return 0;
+
     case WM_DESTROY:
+        renderer.stop();
         PostQuitMessage(0);
         return 0;
 
@@ -66,14 +99,11 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             return -1;
         }
 
-        // Create a scene.
-        Scene scene = createScene(screen);
-
-        // Render the scene.
-        renderScene(&scene, hdc);
+        // Present the latest completed frame.
+        Framebuffer* framebuffer = renderer.acquireFrame();
 
-        // Cleanup.
-        scene.clear();
+        if (framebuffer)
+            presentFramebuffer(hdc, framebuffer);
 
         // Shutdown rendering.
         shutRender(hwnd, &ps);
@@ -98,11 +128,16 @@ Screen initRender(HWND hwnd, PAINTSTRUCT* ps, HDC* hdc)
     }
 
     // Get window dimensions.
+    return measureWindow(hwnd);
+}
+
+Screen measureWindow(HWND hwnd)
+{
     RECT rect;
 
     if (!GetWindowRect(hwnd, &rect))
     {
-        showError(L"initRender::GetWindowRect");
+        showError(L"measureWindow::GetWindowRect");
         return { 0, 0 };
     }
 
@@ -118,172 +153,33 @@ int shutRender(HWND hwnd, PAINTSTRUCT* ps)
     return 0;
 }
 
-Scene createScene(Screen screen)
+int presentFramebuffer(HDC hdc, Framebuffer* framebuffer)
 {
-    Scene scene;
-
-    // Set a camera.
-    Camera* camera = new Camera{
-        (float)screen.width / 2,  // x
-        (float)-screen.height,    // y
-        (float)screen.height / 2, // z
-        screen
-    };
-
-    scene.setCamera(camera);
-
-    // Create light sources.
-    Light* light1 = new Light{ -30, -30, -50, { 0x00000077 }, 1 };
-    Light* light2 = new Light{ 30, 30, 50, { 0x0000FF00 }, 0.5 };
-
-    scene.addLight(light1);
-    scene.addLight(light2);
-
-    // Create objects.
-    /*
-    Sphere* sphere1 = new Sphere{ 0, 13, -1, 4, { 0x000000FF } };
-    Sphere* sphere2 = new Sphere{ -12, 30, 5, 4, { 0x00FF3300 } };
-    Sphere* sphere3 = new Sphere{ 1, 5, -1, 1, { 0x0022FF55 } };
-
-    scene.addObject(sphere1);
-    scene.addObject(sphere2);
-    scene.addObject(sphere3);
-    */
-    Sphere* sphere1 = new Sphere{ 4, 13, 0, 2, { 0x000000FF } };
-    Sphere* sphere2 = new Sphere{ 3, 11, 3, 0.5, { 0x00FF0000 } };
-    Mirror* mirror = new Mirror{ -7, 20, 0, {-12, 1, 0}, 150 };
-
-    scene.addObject(sphere1);
-    scene.addObject(sphere2);
-    scene.addObject(mirror);
-
-    return scene;
-}
+    int width = framebuffer->width;
+    int height = framebuffer->height;
 
-int renderScene(Scene* scene, HDC hdc)
-{
-    // Get scene parameters and parts.
-    Camera* camera = scene->getCamera();
-    Screen screen = camera->getScreen();
-    std::vector<Light*> lightSources = scene->getLightSources();
-    std::vector<Object*> objects = scene->getObjects();
-
-    // Loop though every pixel.
-    for (int x = 0; x < screen.width; x++)
-    {
-        for (int y = 0; y < screen.height; y++)
-        {
-            // Create a ray that goes through the point {x, y}.
-            Primitive ray = Primitive(x, 0, y) - *camera;
-
-            // Find the closest object.
-            float tMin = -1;
-            Object* closestObject = findClosest(&tMin, objects, &ray);
-            
-            // Check reflections and lighten the object.
-            COLORREF lightColor = 0;
-
-            if (closestObject)
-            {
-                if (closestObject->getID() == ID_MIRROR)
-                {
-                    Mirror* mirror = dynamic_cast<Mirror*>(closestObject);
-
-                    // Get reflected ray.
-                    ray = mirror->reflect(&ray);
-
-                    // Find the closest object in reflection.
-                    closestObject = findClosest(&tMin, objects, &ray);
-                }
-
-                // Lighten the closest object.
-                lightColor = lighten(closestObject, lightSources, &ray, tMin);
-            }
-
-            // Dram the pixel on the screen.
-            if (renderPixel(hdc, x, y, lightColor) < 0)
-            {
-                showError(L"renderScene::renderPixel");
-                return -1;
-            }
-        }
-    }
+    std::vector<DWORD> bits((size_t)width * height);
 
-    return 0;
-}
+    readFramebuffer(framebuffer, bits.data());
 
-int renderPixel(HDC hdc, int x, int y, COLORREF lightColor)
-{
-    COLORREF color = lightColor;
+    // Describe a top-down 32-bit bitmap.
+    BITMAPINFO bmi = { };
 
-    SetPixel(hdc, x, y, color);
-
-    return 0;
-}
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
 
-Object* findClosest(float* tMin, std::vector<Object*> objects, Primitive* ray)
-{
-    Object* closestObject = NULL;
-
-    for (Object* object : objects)
+    if (!SetDIBitsToDevice(hdc, 0, 0, width, height, 0, 0, 0, height,
+        bits.data(), &bmi, DIB_RGB_COLORS))
     {
-        float t;
-
-        // Typecast the object properly.
-        switch (object->getID())
-        {
-        case ID_SPHERE:
-        {
-            Sphere* sphere = dynamic_cast<Sphere*>(object);
-
-            t = sphere->intersect(ray);
-
-            break;
-        }
-        case ID_MIRROR:
-        {
-            Mirror* mirror = dynamic_cast<Mirror*>(object);
-
-            t = mirror->intersect(ray);
-
-            break;
-        }
-        default:
-            t = -1;
-            break;
-        }
-
-        // Check if the object is closer than the current one.
-        if ((*tMin > t || *tMin < 0) && t > 0)
-        {
-            *tMin = t;
-            closestObject = object;
-        }
-    }
-
-    return closestObject;
-}
-
-COLORREF lighten(Object* closestObject, std::vector<Light*> lightSources, Primitive* ray, float tMin)
-{
-    COLORREF lightColor = 0;
-
-    if (closestObject)
-    {
-        for (Light* light : lightSources)
-        {
-            // Get the intersection point.
-            Primitive point = *ray * tMin;
-
-            // Calculate light coefficient in the intersection point.
-            float coefficient = light->countLight(&point, closestObject);
-
-            // Add light color to the current pixel color.
-            lightColor += light->lightColor(closestObject, coefficient);
-        }
+        showError(L"presentFramebuffer::SetDIBitsToDevice");
+        return -1;
     }
 
-    return lightColor;
+    return 0;
 }
 
 void showError(const std::wstring& wstrError)
@@ -0,0 +1,530 @@
+#include "render.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+Scene createScene(Screen screen)
+{
+    Scene scene;
+
+    // Set a camera.
+    scene.setCamera(createCamera(screen));
+
+    // Create light sources.
+    Light* light1 = new Light{ -30, -30, -50, { 0x00000077 }, 1 };
+    Light* light2 = new Light{ 30, 30, 50, { 0x0000FF00 }, 0.5 };
+
+    scene.addLight(light1);
+    scene.addLight(light2);
+
+    // Create objects.
+    /*
+    Sphere* sphere1 = new Sphere{ 0, 13, -1, 4, { 0x000000FF } };
+    Sphere* sphere2 = new Sphere{ -12, 30, 5, 4, { 0x00FF3300 } };
+    Sphere* sphere3 = new Sphere{ 1, 5, -1, 1, { 0x0022FF55 } };
+
+    scene.addObject(sphere1);
+    scene.addObject(sphere2);
+    scene.addObject(sphere3);
+    */
+    Sphere* sphere1 = new Sphere{ 4, 13, 0, 2, { 0x000000FF } };
+    Sphere* sphere2 = new Sphere{ 3, 11, 3, 0.5, { 0x00FF0000 } };
+    Mirror* mirror = new Mirror{ -7, 20, 0, {-12, 1, 0}, 150 };
+
+    scene.addObject(sphere1);
+    scene.addObject(sphere2);
+    scene.addObject(mirror);
+
+    // Create copies of shared geometry.
+    /*
+    Sphere* bead = new Sphere{ 0, 0, 0, 1, { 0x0000FFFF } };
+
+    scene.addGeometry(bead);
+
+    for (int i = 0; i < 5; i++)
+        scene.addInstance(bead, -4 + 2 * (float)i, 15, -4, 0.5);
+    */
+
+    return scene;
+}
+
+Camera* createCamera(Screen screen)
+{
+    return new Camera{
+        (float)screen.width / 2,  // x
+        (float)-screen.height,    // y
+        (float)screen.height / 2, // z
+        screen
+    };
+}
+
+int renderScene(Scene* scene, Framebuffer* framebuffer, int order, const std::atomic<bool>* cancel)
+{
+    // Get scene parameters and parts.
+    Camera* camera = scene->getCamera();
+    Screen screen = camera->getScreen();
+    std::vector<Light*> lightSources = scene->getLightSources();
+    std::vector<Object*> objects = scene->getObjects();
+    std::vector<Instance>& instances = scene->getInstances();
+
+    // Find the order of pixels inside a tile.
+    std::vector<int> tileOrder(TILE_SIZE * TILE_SIZE * 2);
+
+    for (int d = 0; d < TILE_SIZE * TILE_SIZE; d++)
+        curvePoint(order, TILE_SIZE, d, &tileOrder[2 * d], &tileOrder[2 * d + 1]);
+
+    // Split the screen into square blocks of tiles that are walked along the curve.
+    // Blocks are not larger than the screen, so less than 4 tiles are walked per screen tile.
+    int block = 1;
+
+    if (order != ORDER_SCANLINE)
+    {
+        while (block * 2 <= framebuffer->tilesX && block * 2 <= framebuffer->tilesY
+            && block * 2 <= MAX_CURVE_BLOCK)
+            block *= 2;
+    }
+
+    int blocksX = (framebuffer->tilesX + block - 1) / block;
+    int blocksY = (framebuffer->tilesY + block - 1) / block;
+
+    // Loop though every block in rows.
+    for (int blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (int blockX = 0; blockX < blocksX; blockX++)
+        {
+            // Loop though every tile in the block.
+            for (int tile = 0; tile < block * block; tile++)
+            {
+                int tileX, tileY;
+
+                curvePoint(order, block, tile, &tileX, &tileY);
+
+                tileX += blockX * block;
+                tileY += blockY * block;
+
+                // Skip tiles outside of the screen.
+                if (tileX >= framebuffer->tilesX || tileY >= framebuffer->tilesY)
+                    continue;
+
+                // Stop if the frame is no longer needed.
+                if (cancel && *cancel)
+                    return 2;
+
+                // Loop though every pixel in the tile.
+                for (int d = 0; d < TILE_SIZE * TILE_SIZE; d++)
+                {
+                    int x = tileX * TILE_SIZE + tileOrder[2 * d];
+                    int y = tileY * TILE_SIZE + tileOrder[2 * d + 1];
+
+                    if (x >= screen.width || y >= screen.height)
+                        continue;
+
+                    // Create a ray that goes through the point {x, y}.
+                    Primitive ray = Primitive(x, 0, y) - *camera;
+
+                    // Find the closest object.
+                    float tMin = -1;
+                    Primitive center;
+                    Object* closestObject = findClosestHit(&tMin, objects, instances, &ray, &center);
+            
+                    // Check reflections and lighten the object.
+                    COLORREF lightColor = 0;
+
+                    if (closestObject)
+                    {
+                        if (closestObject->getID() == ID_MIRROR)
+                        {
+                            Mirror* mirror = dynamic_cast<Mirror*>(closestObject);
+
+                            // Get reflected ray.
+                            ray = mirror->reflect(&ray);
+
+                            // Find the closest object in reflection.
+                            closestObject = findClosestHit(&tMin, objects, instances, &ray, &center);
+                        }
+
+                        // Lighten the closest object.
+                        lightColor = lighten(closestObject, &center, lightSources, &ray, tMin);
+                    }
+
+                    // Draw the pixel in the framebuffer.
+                    if (renderPixel(framebuffer, x, y, lightColor) != 0)
+                        return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int renderPixel(Framebuffer* framebuffer, int x, int y, COLORREF lightColor)
+{
+    if (x < 0 || y < 0 || x >= framebuffer->width || y >= framebuffer->height)
+        return 1;
+
+    // Find the tile and the position inside it.
+    size_t tile = (size_t)(y / TILE_SIZE) * framebuffer->tilesX + x / TILE_SIZE;
+    int offset = (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+
+    framebuffer->pixels[tile * TILE_SIZE * TILE_SIZE + offset] = lightColor;
+
+    return 0;
+}
+
+void resizeFramebuffer(Framebuffer* framebuffer, Screen screen)
+{
+    framebuffer->width = screen.width;
+    framebuffer->height = screen.height;
+
+    // Round the screen up to whole tiles.
+    framebuffer->tilesX = (screen.width + TILE_SIZE - 1) / TILE_SIZE;
+    framebuffer->tilesY = (screen.height + TILE_SIZE - 1) / TILE_SIZE;
+
+    framebuffer->pixels.assign(
+        (size_t)framebuffer->tilesX * framebuffer->tilesY * TILE_SIZE * TILE_SIZE, BG_COLOR);
+}
+
+void readFramebuffer(Framebuffer* framebuffer, DWORD* bits)
+{
+    int width = framebuffer->width;
+    int height = framebuffer->height;
+
+    // Convert tiles to rows.
+    // COLORREF format: 0x00BBGGRR, DIB format: 0x00RRGGBB.
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            size_t tile = (size_t)(y / TILE_SIZE) * framebuffer->tilesX + x / TILE_SIZE;
+            int offset = (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+            COLORREF color = framebuffer->pixels[tile * TILE_SIZE * TILE_SIZE + offset];
+
+            bits[(size_t)y * width + x] = (GetRValue(color) << 16)
+                | (GetGValue(color) << 8)
+                | GetBValue(color);
+        }
+    }
+}
+
+void curvePoint(int order, int side, int d, int* x, int* y)
+{
+    *x = *y = 0;
+
+    switch (order)
+    {
+    case ORDER_MORTON:
+    {
+        // Even bits of the position make x, odd bits make y.
+        for (int bit = 0; (1 << bit) < side; bit++)
+        {
+            *x |= ((d >> (2 * bit)) & 1) << bit;
+            *y |= ((d >> (2 * bit + 1)) & 1) << bit;
+        }
+
+        break;
+    }
+    case ORDER_HILBERT:
+    {
+        // Walk the quadrants from the smallest one.
+        for (int s = 1; s < side; s *= 2)
+        {
+            int rx = 1 & (d / 2);
+            int ry = 1 & (d ^ rx);
+
+            // Rotate the quadrant.
+            if (ry == 0)
+            {
+                if (rx == 1)
+                {
+                    *x = s - 1 - *x;
+                    *y = s - 1 - *y;
+                }
+
+                int t = *x;
+                *x = *y;
+                *y = t;
+            }
+
+            *x += s * rx;
+            *y += s * ry;
+            d /= 4;
+        }
+
+        break;
+    }
+    default:
+        *x = d % side;
+        *y = d / side;
+        break;
+    }
+}
+
+Object* findClosest(float* tMin, const std::vector<Object*>& objects, Primitive* ray)
+{
+    Object* closestObject = NULL;
+
+    for (Object* object : objects)
+    {
+        float t;
+
+        // Typecast the object properly.
+        switch (object->getID())
+        {
+        case ID_SPHERE:
+        {
+            Sphere* sphere = dynamic_cast<Sphere*>(object);
+
+            t = sphere->intersect(ray);
+
+            break;
+        }
+        case ID_MIRROR:
+        {
+            Mirror* mirror = dynamic_cast<Mirror*>(object);
+
+            t = mirror->intersect(ray);
+
+            break;
+        }
+        default:
+            t = -1;
+            break;
+        }
+
+        // Check if the object is closer than the current one.
+        if ((*tMin > t || *tMin < 0) && t > 0)
+        {
+            *tMin = t;
+            closestObject = object;
+        }
+    }
+
+    return closestObject;
+}
+
+Instance* findClosestInstance(float* tMin, std::vector<Instance>& instances, Primitive* ray)
+{
+    Instance* closestInstance = NULL;
+
+    for (Instance& instance : instances)
+    {
+        float t = instance.intersect(ray);
+
+        // Check if the instance is closer than the current one.
+        if ((*tMin > t || *tMin < 0) && t > 0)
+        {
+            *tMin = t;
+            closestInstance = &instance;
+        }
+    }
+
+    return closestInstance;
+}
+
+Object* findClosestHit(float* tMin, const std::vector<Object*>& objects, std::vector<Instance>& instances,
+    Primitive* ray, Primitive* center)
+{
+    // Check objects that are placed in the scene directly.
+    Object* closestObject = findClosest(tMin, objects, ray);
+
+    if (closestObject) *center = *closestObject;
+
+    // Check instances of shared geometry.
+    Instance* closestInstance = findClosestInstance(tMin, instances, ray);
+
+    if (closestInstance)
+    {
+        closestObject = closestInstance->getGeometry();
+        *center = closestInstance->getCenter();
+    }
+
+    return closestObject;
+}
+
+COLORREF lighten(Object* closestObject, Primitive* objectCenter, std::vector<Light*> lightSources,
+    Primitive* ray, float tMin)
+{
+    COLORREF lightColor = 0;
+
+    if (closestObject)
+    {
+        for (Light* light : lightSources)
+        {
+            // Get the intersection point.
+            Primitive point = *ray * tMin;
+
+            // Calculate light coefficient in the intersection point.
+            float coefficient = light->countLight(&point, objectCenter);
+
+            // Add light color to the current pixel color.
+            lightColor += light->lightColor(closestObject, coefficient);
+        }
+    }
+
+    return lightColor;
+}
+
+int runServer(FILE* in, FILE* out)
+{
+#ifdef _WIN32
+    // Responses contain raw pixels.
+    _setmode(_fileno(out), _O_BINARY);
+#endif
+
+    RenderServer server;
+
+    server.start();
+
+    // Read requests until the end of the stream.
+    char line[512];
+
+    while (std::fgets(line, sizeof(line), in))
+    {
+        RenderRequest request;
+        char scene[256] = "";
+
+        // Skip blank lines.
+        if (line[std::strspn(line, " \t\r\n")] == '\0') continue;
+
+        if (std::strncmp(line, "QUIT", 4) == 0) break;
+
+        int fields = std::sscanf(line, "RENDER %d %255s %d %d %d %f %f %f", &request.id, scene,
+            &request.screen.width, &request.screen.height, &request.order,
+            &request.camera.x, &request.camera.y, &request.camera.z);
+
+        request.scene = scene;
+        request.customCamera = fields == 8;
+
+        // Malformed requests are answered by the server thread as well,
+        // so that responses never interleave.
+        if ((fields != 4 && fields != 5 && fields != 8)
+            || request.screen.width <= 0 || request.screen.width > MAX_SCREEN_SIDE
+            || request.screen.height <= 0 || request.screen.height > MAX_SCREEN_SIDE
+            || request.order < ORDER_SCANLINE || request.order > ORDER_HILBERT)
+            request.screen = { 0, 0 };
+
+        // Write the response from the server thread.
+        request.reply = [out](RenderRequest* r, Framebuffer* frame)
+        {
+            std::vector<DWORD> bits;
+
+            if (frame)
+            {
+                try
+                {
+                    bits.resize((size_t)frame->width * frame->height);
+                    readFramebuffer(frame, bits.data());
+                }
+                catch (const std::bad_alloc&)
+                {
+                    frame = NULL;
+                }
+            }
+
+            if (!frame)
+            {
+                std::fprintf(out, "ERROR %d\n", r->id);
+                std::fflush(out);
+                return;
+            }
+
+            std::fprintf(out, "FRAME %d %d %d %zu\n", r->id, frame->width, frame->height,
+                bits.size() * sizeof(DWORD));
+            std::fwrite(bits.data(), sizeof(DWORD), bits.size(), out);
+            std::fflush(out);
+        };
+
+        server.submit(request);
+    }
+
+    // Answer the remaining requests.
+    server.stop();
+
+    return 0;
+}
+
+int runLoadGenerator(int requests, int clients, FILE* out)
+{
+    if (requests <= 0 || clients <= 0)
+        return 1;
+
+    RenderServer server;
+
+    server.start();
+
+    // Latencies of all requests in microseconds.
+    std::vector<double> latencies(requests);
+    std::atomic<int> next(0);
+    std::atomic<int> failures(0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Every client sends one request at a time and waits for the reply.
+    std::vector<std::thread> threads;
+
+    for (int c = 0; c < clients; c++)
+    {
+        threads.emplace_back([&]
+        {
+            for (int i = next++; i < requests; i = next++)
+            {
+                std::promise<bool> done;
+                std::future<bool> replied = done.get_future();
+                RenderRequest request;
+
+                // Cycle through a few screens and cameras, so that concurrent
+                // requests are sometimes identical and can be coalesced.
+                int camera = (i / LOADGEN_SCREENS) % LOADGEN_CAMERAS;
+
+                request.id = i;
+                request.screen = { 160 * (1 + i % LOADGEN_SCREENS), 120 * (1 + i % LOADGEN_SCREENS) };
+
+                // Move the default camera sideways.
+                request.customCamera = true;
+                request.camera = {
+                    (float)request.screen.width / 2 + 10 * camera,
+                    (float)-request.screen.height,
+                    (float)request.screen.height / 2
+                };
+
+                request.reply = [&done](RenderRequest*, Framebuffer* frame)
+                {
+                    done.set_value(frame != NULL);
+                };
+
+                auto sent = std::chrono::steady_clock::now();
+
+                server.submit(request);
+
+                if (!replied.get()) failures++;
+
+                latencies[i] = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - sent).count();
+            }
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int frames = server.getFramesRendered();
+
+    server.stop();
+
+    // Report throughput and latency percentiles.
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) { return latencies[(size_t)(p * (requests - 1))] / 1000; };
+
+    std::fprintf(out, "requests %d, clients %d, failures %d, frames rendered %d\n",
+        requests, clients, failures.load(), frames);
+    std::fprintf(out, "throughput %.1f requests/s, %.1f frames/s\n", requests / seconds, frames / seconds);
+    std::fprintf(out, "latency ms: p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n",
+        percentile(0.5), percentile(0.9), percentile(0.99), percentile(1));
+
+    return failures == 0 ? 0 : 1;
+}
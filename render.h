@@ -0,0 +1,1095 @@
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdint>
+
+// Win32 color types and macros used by the renderer.
+typedef uint8_t BYTE;
+typedef uint32_t DWORD;
+typedef DWORD COLORREF;
+
+#define GetRValue(rgb)  ((BYTE)(rgb))
+#define GetGValue(rgb)  ((BYTE)((rgb) >> 8))
+#define GetBValue(rgb)  ((BYTE)((rgb) >> 16))
+#endif
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "fastmath.h"
+
+// Constants.
+#define BG_COLOR        0x00000000  // pixel outside spheres are black
+#define TILE_SIZE       8           // side of a framebuffer tile in pixels (power of two)
+#define MAX_CURVE_BLOCK 64          // side of the largest block of tiles walked by one curve
+#define PIXEL_ORDER     ORDER_HILBERT
+#define SCENE_DEFAULT   "default"       // name of the scene built by createScene()
+#define MAX_SCREEN_SIDE 8192            // largest width or height the render server accepts
+#define LOADGEN_SCREENS 3               // number of distinct screens the load generator requests
+#define LOADGEN_CAMERAS 4               // number of distinct cameras the load generator requests
+
+// Pixel traversal orders.
+#define ORDER_SCANLINE  1
+#define ORDER_MORTON    2
+#define ORDER_HILBERT   3
+
+// Object identifiers.
+#define ID_DEFAULT  1
+#define ID_SPHERE   2
+#define ID_MIRROR   3
+
+// Struct that contains coordinates in 3D space.
+struct Coordinates3D
+{
+    float x = 0;
+    float y = 0;
+    float z = 0;
+};
+
+// Struct that contains data about an object material.
+struct Material
+{
+    COLORREF color = BG_COLOR;
+};
+
+// Struct that contains data about a screen.
+struct Screen
+{
+    int width = 0;
+    int height = 0;
+};
+
+// Struct that contains rendered pixels.
+// Pixels are stored in row-major tiles of TILE_SIZE x TILE_SIZE pixels,
+// each tile being row-major itself.
+struct Framebuffer
+{
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<COLORREF> pixels;
+};
+
+// Base class that represents a point/vector in space.
+class Primitive
+{
+public:
+    Primitive() {}
+    Primitive(float x, float y, float z) : coordinates({ x, y, z }) {}
+
+    Coordinates3D getCoordinates()
+    {
+        return coordinates;
+    }
+
+    void moveTo(float x, float y, float z)
+    {
+        coordinates = { x, y, z };
+    }
+
+    // Calculate vector's length.
+    float length()
+    {
+        return std::sqrt(lengthSquared());
+    }
+
+    // Calculate vector's squared length.
+    float lengthSquared()
+    {
+        return coordinates.x * coordinates.x
+            + coordinates.y * coordinates.y
+            + coordinates.z * coordinates.z;
+    }
+
+    // Subtract points/vectors.
+    Primitive operator-(Primitive point)
+    {
+        // Get vector coordinates.
+        Coordinates3D pCoordinates = point.getCoordinates();
+
+        return Primitive(
+            coordinates.x - pCoordinates.x,
+            coordinates.y - pCoordinates.y,
+            coordinates.z - pCoordinates.z
+        );
+    }
+
+    // Add points/vectors.
+    Primitive operator+(Primitive point)
+    {
+        // Get vector coordinates.
+        Coordinates3D pCoordinates = point.getCoordinates();
+
+        return Primitive(
+            coordinates.x + pCoordinates.x,
+            coordinates.y + pCoordinates.y,
+            coordinates.z + pCoordinates.z
+        );
+    }
+
+    // Multiply the point/vector by a scalar.
+    Primitive operator*(float t)
+    {
+        return Primitive(
+            coordinates.x * t,
+            coordinates.y * t,
+            coordinates.z * t
+        );
+    }
+
+    // Calculate a dot product of the current and passed vectors.
+    float operator*(Primitive vector)
+    {
+        Coordinates3D vCoordinates = vector.getCoordinates();
+        return coordinates.x * vCoordinates.x
+            + coordinates.y * vCoordinates.y
+            + coordinates.z * vCoordinates.z;
+    }
+
+protected:
+    // Coordinates of the point/vector.
+    Coordinates3D coordinates;
+};
+
+// Class that represents a camera.
+class Camera : public Primitive
+{
+public:
+    Camera() {}
+    Camera(float x, float y, float z, Screen cameraScreen)
+    {
+        coordinates = { x, y, z };
+        screen = cameraScreen;
+    }
+
+    Screen getScreen()
+    {
+        return screen;
+    }
+
+private:
+    // Screen parameters.
+    Screen screen;
+};
+
+// Base class that represents a 3D object.
+class Object : public Primitive
+{
+public:
+    Object() {}
+    Object(float x, float y, float z, Material objectMaterial)
+    {
+        coordinates = { x, y, z };
+        material = objectMaterial;
+    }
+    virtual ~Object() {}
+
+    int getID() { return id; }
+
+    Material getMaterial() { return material; }
+
+    // Move the object. Objects that cache their position override this.
+    virtual void moveTo(float x, float y, float z)
+    {
+        coordinates = { x, y, z };
+    }
+
+    // Find the coefficient of intersection point between the object and a vector.
+    virtual float intersect(Primitive* vector)
+    {
+        // Vectors start in the origin of coordinates.
+        Primitive origin;
+
+        return intersectFrom(&origin, vector);
+    }
+
+    // Find the coefficient of intersection point between the object and a vector
+    // that starts in the passed point.
+    virtual float intersectFrom(Primitive* origin, Primitive* vector)
+    {
+        // Get coordinates of the object relative to the vector's origin.
+        Coordinates3D oCoordinates = (*this - *origin).getCoordinates();
+
+        // Get vector's coordinates.
+        Coordinates3D vCoordinates = vector->getCoordinates();
+
+        // Calculate the relation of Object's x and vector's x.
+        float t = oCoordinates.x / vCoordinates.x;
+
+        // Check if the relation is the same for every coordinate.
+        // If so, the vector intersects with the object.
+        if (t == oCoordinates.y / vCoordinates.y && t == oCoordinates.z / vCoordinates.z)
+            return t;
+
+        return -1;
+    }
+
+protected:
+    int id = ID_DEFAULT;
+    // Material parameters.
+    Material material;
+};
+
+// Class that represents a round reflective surface.
+class Mirror : public Object
+{
+public:
+    Mirror()
+    {
+        id = ID_MIRROR;
+        radiusSquared = planeDistance = 0;
+    }
+    Mirror(float x, float y, float z, Primitive normalVector, float mirrorRadius)
+    {
+        id = ID_MIRROR;
+        coordinates = { x, y, z };
+
+        // Normalize the vector.
+        normal = normalVector * (1 / normalVector.length());
+
+        // Precompute constants of the intersection equation.
+        radiusSquared = mirrorRadius * mirrorRadius;
+        planeDistance = normal * *this;
+    }
+
+    void moveTo(float x, float y, float z) override
+    {
+        coordinates = { x, y, z };
+        planeDistance = normal * *this;
+    }
+
+    float intersect(Primitive* vector) override
+    {
+        // Same as intersectFrom() for the origin of coordinates,
+        // with the mirror's side of the equation precomputed.
+        float denominator = normal * *vector;
+
+        if (denominator == 0) return -1;
+
+        float t = divide(planeDistance, denominator);
+
+        // Check if the intersection point lies on mirror.
+        if (vector->lengthSquared() * t * t > radiusSquared) return -1;
+
+        return t;
+    }
+
+    float intersectFrom(Primitive* origin, Primitive* vector) override
+    {
+        // Find the closest intersection point from the intersection equation.
+        // Mirror origin (relative to the vector's origin): { x0, y0, z0 }
+        // Vector: { x, y, z }
+        // Normal vector: { A, B, C }
+        // Mirror surface: A(x0 - x*t) + B(y0 - y*t) + C(z0 - z*t) = 0
+        // Intersection point: { x*t, y*t, z*t }
+
+        // Get required coordinates.
+        Coordinates3D oc = (*this - *origin).getCoordinates();
+        Coordinates3D nc = normal.getCoordinates();
+        Coordinates3D vc = vector->getCoordinates();
+
+        // Calculate the coefficient and find the intersection point.
+        float denominator = nc.x * vc.x + nc.y * vc.y + nc.z * vc.z;
+
+        if (denominator == 0) return -1;
+
+        float t = divide(nc.x * oc.x + nc.y * oc.y + nc.z * oc.z, denominator);
+
+        Primitive intersection = *vector * t;
+
+        // Check if the intersection point lies on mirror.
+        if (intersection.lengthSquared() > radiusSquared) return -1;
+
+        return t;
+    }
+
+    Primitive reflect(Primitive* vector)
+    {
+        return *vector - (normal * (*vector * normal)) * 2;
+    }
+
+private:
+    // Normal vector that sets the direction.
+    Primitive normal;
+    // Precomputed radius^2 and normal * origin.
+    float radiusSquared;
+    float planeDistance;
+};
+
+// Class that represents a sphere object.
+class Sphere : public Object
+{
+public:
+    Sphere()
+    {
+        id = ID_SPHERE;
+        radiusSquared = centerConstant = 0;
+    }
+    Sphere(float x, float y, float z, float sphereRadius, Material objectMaterial)
+    {
+        id = ID_SPHERE;
+        coordinates = { x, y, z };
+        material = objectMaterial;
+
+        // Precompute constants of the intersection equation.
+        radiusSquared = sphereRadius * sphereRadius;
+        centerConstant = lengthSquared() - radiusSquared;
+    }
+
+    void moveTo(float x, float y, float z) override
+    {
+        coordinates = { x, y, z };
+        centerConstant = lengthSquared() - radiusSquared;
+    }
+
+    float intersect(Primitive* vector) override
+    {
+        // Same as intersectFrom() for the origin of coordinates,
+        // with the free coefficient precomputed.
+        float a = vector->lengthSquared();
+        float b = -2 * (*vector * *this);
+
+        return solve(a, b, centerConstant);
+    }
+
+    float intersectFrom(Primitive* origin, Primitive* vector) override
+    {
+        // Get sphere's center relative to the vector's origin.
+        Coordinates3D oCoordinates = (*this - *origin).getCoordinates();
+
+        // Get vector's coordinates.
+        Coordinates3D vCoordinates = vector->getCoordinates();
+
+        // Calculate the coefficients of the intersection equation.
+        // Sphere: x^2 + y^2 + z^2 = R^2
+        // Vector: { x, y, z }
+        // Intersection point: { x*t, y*t, z*t }
+        float a = vCoordinates.x * vCoordinates.x
+            + vCoordinates.y * vCoordinates.y
+            + vCoordinates.z * vCoordinates.z;
+        float b = -2 * (vCoordinates.x * oCoordinates.x
+            + vCoordinates.y * oCoordinates.y
+            + vCoordinates.z * oCoordinates.z);
+        float c = oCoordinates.x * oCoordinates.x
+            + oCoordinates.y * oCoordinates.y
+            + oCoordinates.z * oCoordinates.z - radiusSquared;
+
+        return solve(a, b, c);
+    }
+
+private:
+    // Find the closest positive root of a*t^2 + b*t + c = 0.
+    float solve(float a, float b, float c)
+    {
+        // Calculate the discriminant.
+        float d = b * b - 4 * a * c;
+
+        // Find the closest intersection point.
+        float t = -1;
+
+        if (d >= 0)
+        {
+            float sqrtD = squareRoot(d);
+
+            if (-b + sqrtD > 0)
+                t = divide(-b + sqrtD, 2 * a);
+            if (-b - sqrtD > 0)
+                t = divide(-b - sqrtD, 2 * a);
+        }
+
+        return t;
+    }
+
+    // Precomputed radius^2 and |center|^2 - radius^2.
+    float radiusSquared;
+    float centerConstant;
+};
+
+// Class that represents a transformed copy of shared geometry.
+// Instances are stored by value in the scene and only reference the geometry,
+// so memory scales with unique objects rather than with the number of copies.
+class Instance
+{
+public:
+    Instance()
+    {
+        geometry = NULL;
+        scale = 1;
+    }
+    Instance(Object* instanceGeometry, float x, float y, float z, float instanceScale)
+    {
+        geometry = instanceGeometry;
+        scale = instanceScale;
+
+        // Rays start in the origin of the scene, so their origin in object space is constant.
+        origin = Primitive(x, y, z) * (-1 / scale);
+    }
+
+    Object* getGeometry() { return geometry; }
+
+    // Get the position of the geometry's origin in the scene.
+    Primitive getCenter()
+    {
+        return (*geometry - origin) * scale;
+    }
+
+    // Find the coefficient of intersection point between the instance and a vector.
+    float intersect(Primitive* vector)
+    {
+        // Object space only differs by the scale of the vector, so the vector is used as is
+        // and the coefficient found for it is scaled back.
+        float t = geometry->intersectFrom(&origin, vector);
+
+        if (t > 0) return t * scale;
+
+        return t;
+    }
+
+private:
+    // Shared geometry (owned by the scene).
+    Object* geometry;
+    // Origin of the scene in object space.
+    Primitive origin;
+    // Scale from object to scene space.
+    float scale;
+};
+
+// Class that represents point light.
+class Light : public Primitive
+{
+public:
+    Light()
+    {
+        color = power = 0;
+    }
+    Light(float x, float y, float z, COLORREF lightColor, float lightPower)
+    {
+        coordinates = { x, y, z };
+        color = lightColor;
+        power = lightPower;
+    }
+
+    // Calculate exposure of object's point to light.
+    float countLight(Primitive* objectPoint, Primitive* objectCenter)
+    {
+        // Create the vector that points from the light source to a point.
+        Primitive lightToPoint = *this - *objectPoint;
+
+        // Create the vector that points from the point to sphere's center.
+        Primitive pointToCenter = *objectPoint - *objectCenter;
+
+        // Calculate cosine of angle between created vectors.
+#ifdef FAST_MATH
+        float cos = lightToPoint * pointToCenter
+            * reciprocalSqrt(lightToPoint.lengthSquared() * pointToCenter.lengthSquared());
+#else
+        float cos = lightToPoint * pointToCenter / (lightToPoint.length() * pointToCenter.length());
+#endif
+
+        if (cos > 0 && cos < 1) return cos;
+
+        return 0;
+    }
+
+    // Calculate the color of an object in light.
+    COLORREF lightColor(Object* object, float coefficient)
+    {
+        Material objectMaterial = object->getMaterial();
+
+        // COLORREF (typedef DWORD) format: 0x00BBGGRR
+        COLORREF newObjectColor = 0;
+
+        for (int i = 0; i <= 16; i += 8)
+        {
+            // Get light and object color channels.
+            int lightChannel = (color >> i) % 256;
+            int objectChannel = (objectMaterial.color >> i) % 256;
+
+            // Create a new color channel.
+            int newObjectChannel = (lightChannel + objectChannel) * power * coefficient;
+
+            if (newObjectChannel > 0xFF) newObjectChannel = 0xFF;
+
+            // Add the color channel to final color.
+            newObjectColor |= newObjectChannel << i;
+        }
+
+        return newObjectColor;
+    }
+
+private:
+    // Light parameters.
+    COLORREF color;
+    float power;
+};
+
+// Class that contains the whole scene (light sources and objects).
+class Scene
+{
+public:
+    Scene()
+    {
+        camera = NULL;
+    }
+    Scene(Camera* sceneCamera)
+    {
+        camera = sceneCamera;
+    }
+
+    void setCamera(Camera* newCamera)
+    {
+        // Free memory of current camera.
+        if (camera) delete camera;
+
+        camera = newCamera;
+    }
+
+    Camera* getCamera() { return camera; }
+
+    std::vector<Light*> getLightSources() { return lightSources; }
+
+    std::vector<Object*> getObjects() { return objects; }
+
+    std::vector<Instance>& getInstances() { return instances; }
+
+    void addLight(Light* light) { lightSources.push_back(light); }
+
+    void addObject(Object* object) { objects.push_back(object); }
+
+    // Add geometry that is only rendered through instances.
+    void addGeometry(Object* object) { geometries.push_back(object); }
+
+    // Place a copy of the geometry in the scene.
+    // Return value:
+    //     0 - success.
+    //     1 - failure (no geometry or non-positive scale).
+    int addInstance(Object* geometry, float x, float y, float z, float scale)
+    {
+        // The scale is inverted when rays are transformed into object space.
+        if (!geometry || !(scale > 0)) return 1;
+
+        instances.push_back(Instance(geometry, x, y, z, scale));
+
+        return 0;
+    }
+
+    // Free all memory.
+    void clear()
+    {
+        for (Light* l : lightSources)
+            if (l) delete l;
+
+        for (Object* o : objects)
+            if (o) delete o;
+
+        for (Object* g : geometries)
+            if (g) delete g;
+
+        if (camera) delete camera;
+
+        camera = NULL;
+        lightSources.clear();
+        objects.clear();
+        geometries.clear();
+        instances.clear();
+    }
+
+private:
+    // Scene parts.
+    Camera* camera;
+    std::vector<Light*> lightSources;
+    std::vector<Object*> objects;
+    std::vector<Object*> geometries;
+    std::vector<Instance> instances;
+};
+
+// Function prototypes.
+// Create a scene to render.
+// Return value:
+//     Scene object.
+Scene createScene(
+    Screen screen   // [in] screen parameters for a camera setup.
+);
+// Create a camera that looks at the scene through the screen.
+// Return value:
+//     Pointer to Camera.
+Camera* createCamera(
+    Screen screen   // [in] screen parameters.
+);
+// Render a scene.
+// Return value:
+//     0 - success.
+//     1 - failure.
+//     2 - cancelled.
+int renderScene(
+    Scene* scene,                       // [in] scene that should be rendered.
+    Framebuffer* framebuffer,           // [out] framebuffer that receives the image.
+    int order,                          // [in] pixel traversal order (ORDER_*).
+    const std::atomic<bool>* cancel     // [in] flag that stops rendering when set (may be NULL).
+);
+// Render pixel with provided color.
+// Return value:
+//     0 - success.
+//     1 - failure.
+int renderPixel(
+    Framebuffer* framebuffer,   // [in, out] framebuffer used for rendering.
+    int x,                      // [in] horizontal position of the pixel.
+    int y,                      // [in] vertical position of the pixel.
+    COLORREF lightColor         // [in] color of the pixel.
+);
+// Allocate tiled storage for the screen.
+void resizeFramebuffer(
+    Framebuffer* framebuffer,   // [in, out] framebuffer to resize.
+    Screen screen               // [in] screen parameters.
+);
+// Convert the framebuffer to top-down rows of 0x00RRGGBB pixels.
+void readFramebuffer(
+    Framebuffer* framebuffer,   // [in] rendered framebuffer.
+    DWORD* bits                 // [out] array of width * height pixels.
+);
+// Find a cell of a square grid by its position along a traversal curve.
+void curvePoint(
+    int order,  // [in] traversal order (ORDER_*).
+    int side,   // [in] side of the grid (power of two).
+    int d,      // [in] position along the curve.
+    int* x,     // [out] horizontal position of the cell.
+    int* y      // [out] vertical position of the cell.
+);
+// Find closest object to the camera.
+// Return value:
+//     Pointer to Object.
+Object* findClosest(
+    float* tMin,                            // [in, out] pointer to the coefficient of proximity.
+    const std::vector<Object*>& objects,    // [in] array of objects in the scene.
+    Primitive* ray                          // [in] ray whose interception points we are searching.
+);
+// Find closest instance to the camera.
+// Return value:
+//     Pointer to Instance.
+Instance* findClosestInstance(
+    float* tMin,                        // [in, out] pointer to the coefficient of proximity.
+    std::vector<Instance>& instances,   // [in] array of instances in the scene.
+    Primitive* ray                      // [in] ray whose interception points we are searching.
+);
+// Find closest object or instance to the camera.
+// Return value:
+//     Pointer to Object (shared geometry in case of an instance).
+Object* findClosestHit(
+    float* tMin,                            // [in, out] pointer to the coefficient of proximity.
+    const std::vector<Object*>& objects,    // [in] array of objects in the scene.
+    std::vector<Instance>& instances,       // [in] array of instances in the scene.
+    Primitive* ray,                         // [in] ray whose interception points we are searching.
+    Primitive* center                       // [out] position of the hit object in the scene.
+);
+// Set color to the closest object according to lighting of the scene.
+// Return value:
+//     COLORREF color.
+COLORREF lighten(
+    Object* closestObject,            // [in] pointer to the closest object.
+    Primitive* objectCenter,          // [in] position of the closest object in the scene.
+    std::vector<Light*> lightSources, // [in] array of light sources in the scene.
+    Primitive* ray,                   // [in] ray whose interception points we are searching.
+    float tMin                        // [in] coefficient of proximity.
+);
+// Serve render requests read from a stream.
+// Request:  RENDER <id> <scene> <width> <height> [order [x y z]]
+//           where x y z is the camera position (by default the one of createCamera()),
+//           width and height are 1..MAX_SCREEN_SIDE.
+// Response: FRAME <id> <width> <height> <size>, newline and size bytes of
+//           top-down 0x00RRGGBB pixels, or ERROR <id> on failure.
+// Lines that are not valid requests are answered with ERROR <id>, or ERROR 0
+// if the id cannot be read. Blank lines are ignored.
+// Responses are written by the server thread only. Coalesced requests are
+// answered together, so responses should be matched by id.
+// The server stops on QUIT or at the end of the stream.
+// Return value:
+//     0 - success.
+int runServer(
+    FILE* in,   // [in] stream of requests.
+    FILE* out   // [in] stream of responses.
+);
+// Measure latency and throughput of the render server under concurrent load.
+// Requests cycle through LOADGEN_SCREENS screens and LOADGEN_CAMERAS cameras.
+// Return value:
+//     0 - success.
+//     1 - failure.
+int runLoadGenerator(
+    int requests,   // [in] total number of requests.
+    int clients,    // [in] number of concurrent clients.
+    FILE* out       // [in] stream for the report.
+);
+
+// Class that renders frames on a background thread.
+// Frames are published with triple buffering: the render thread draws into one
+// buffer, the latest completed frame waits in another one and the presenting
+// thread reads the third, so neither side waits for the other.
+class Renderer
+{
+public:
+    Renderer()
+    {
+        running = pending = fresh = presentable = false;
+        cancel = false;
+        requestedOrder = PIXEL_ORDER;
+        rendering = 0;
+        ready = 1;
+        presented = 2;
+    }
+
+    ~Renderer() { stop(); }
+
+    // Start the render thread.
+    // The callback is called from the render thread when a frame is published.
+    void start(std::function<void()> onFrame)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (running) return;
+
+        frameCallback = onFrame;
+        running = true;
+        worker = std::thread(&Renderer::run, this);
+    }
+
+    // Cancel the in-flight frame and stop the render thread.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!running) return;
+
+            running = false;
+            cancel = true;
+        }
+
+        wakeup.notify_one();
+        worker.join();
+    }
+
+    // Request a new frame. The in-flight frame is cancelled.
+    void request(Screen screen, int order)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            requestedScreen = screen;
+            requestedOrder = order;
+            pending = true;
+            cancel = true;
+        }
+
+        wakeup.notify_one();
+    }
+
+    // Get the latest completed frame.
+    // Return value:
+    //     Pointer to Framebuffer (valid until the next call) or NULL if no frame is completed yet.
+    Framebuffer* acquireFrame()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Take the newer frame if it was published since the last call.
+        if (fresh)
+        {
+            std::swap(ready, presented);
+            fresh = false;
+            presentable = true;
+        }
+
+        return presentable ? &buffers[presented] : NULL;
+    }
+
+private:
+    // Render requested frames until the renderer is stopped.
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true)
+        {
+            wakeup.wait(lock, [this] { return pending || !running; });
+
+            if (!running) break;
+
+            // Take the request.
+            Screen screen = requestedScreen;
+            int order = requestedOrder;
+            Framebuffer* framebuffer = &buffers[rendering];
+
+            pending = false;
+            cancel = false;
+
+            lock.unlock();
+
+            // Render the frame without holding the lock.
+            Scene scene = createScene(screen);
+
+            resizeFramebuffer(framebuffer, screen);
+
+            int result = renderScene(&scene, framebuffer, order, &cancel);
+
+            scene.clear();
+
+            lock.lock();
+
+            if (result != 0) continue;
+
+            // Publish the frame.
+            std::swap(rendering, ready);
+            fresh = true;
+
+            if (frameCallback)
+            {
+                lock.unlock();
+                frameCallback();
+                lock.lock();
+            }
+        }
+    }
+
+    // Render thread and its state.
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::function<void()> frameCallback;
+    std::atomic<bool> cancel;
+    bool running;
+    // Last request.
+    bool pending;
+    Screen requestedScreen;
+    int requestedOrder;
+    // Frame buffers and their roles.
+    Framebuffer buffers[3];
+    int rendering;
+    int ready;
+    int presented;
+    bool fresh;
+    bool presentable;
+};
+
+// Struct that contains a request to the render server.
+struct RenderRequest
+{
+    int id = 0;
+    std::string scene = SCENE_DEFAULT;
+    Screen screen;
+    int order = PIXEL_ORDER;
+    // Camera position, used if customCamera is set.
+    bool customCamera = false;
+    Coordinates3D camera;
+    // Called from the server thread with the frame (NULL on failure).
+    // The frame is only valid during the call.
+    std::function<void(RenderRequest*, Framebuffer*)> reply;
+};
+
+// Class that renders queued requests on a long-lived thread.
+// Scenes stay loaded between requests. Identical queued requests (same scene,
+// screen, camera and order) are coalesced and answered with a single frame.
+class RenderServer
+{
+public:
+    RenderServer()
+    {
+        running = false;
+        framesRendered = 0;
+    }
+
+    ~RenderServer() { stop(); }
+
+    // Start the server thread.
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (running) return;
+
+        running = true;
+        worker = std::thread(&RenderServer::run, this);
+    }
+
+    // Answer queued requests, stop the server thread and unload scenes.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!running) return;
+
+            running = false;
+        }
+
+        wakeup.notify_one();
+        worker.join();
+
+        for (auto& entry : scenes)
+            entry.second.clear();
+
+        scenes.clear();
+    }
+
+    // Queue a request.
+    void submit(RenderRequest request)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            queue.push_back(request);
+        }
+
+        wakeup.notify_one();
+    }
+
+    // Get the number of frames rendered so far.
+    int getFramesRendered() { return framesRendered; }
+
+private:
+    // Render batches of queued requests until the server is stopped.
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true)
+        {
+            wakeup.wait(lock, [this] { return !queue.empty() || !running; });
+
+            if (queue.empty()) break;
+
+            // Take every queued request as one batch.
+            std::deque<RenderRequest> batch;
+
+            batch.swap(queue);
+
+            lock.unlock();
+
+            renderBatch(batch);
+
+            lock.lock();
+        }
+    }
+
+    // Render each distinct frame of the batch once and answer all its requests.
+    void renderBatch(std::deque<RenderRequest>& batch)
+    {
+        std::vector<bool> answered(batch.size(), false);
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            if (answered[i]) continue;
+
+            RenderRequest* request = &batch[i];
+            Framebuffer* frame = render(request);
+
+            // Answer requests for the same frame.
+            for (size_t j = i; j < batch.size(); j++)
+            {
+                RenderRequest* other = &batch[j];
+
+                if (!isSameFrame(request, other)) continue;
+
+                answered[j] = true;
+
+                if (other->reply) other->reply(other, frame);
+            }
+        }
+    }
+
+    // Check if two requests produce the same frame.
+    bool isSameFrame(RenderRequest* a, RenderRequest* b)
+    {
+        if (a->scene != b->scene
+            || a->screen.width != b->screen.width
+            || a->screen.height != b->screen.height
+            || a->order != b->order
+            || a->customCamera != b->customCamera)
+            return false;
+
+        return !a->customCamera
+            || (a->camera.x == b->camera.x && a->camera.y == b->camera.y && a->camera.z == b->camera.z);
+    }
+
+    // Render a request with a resident scene.
+    // Return value:
+    //     Pointer to Framebuffer or NULL on failure.
+    Framebuffer* render(RenderRequest* request)
+    {
+        Screen screen = request->screen;
+
+        if (screen.width <= 0 || screen.height <= 0
+            || screen.width > MAX_SCREEN_SIDE || screen.height > MAX_SCREEN_SIDE)
+            return NULL;
+
+        // A failed allocation only fails the request, not the server.
+        try
+        {
+            Scene* scene = loadScene(request->scene, screen);
+
+            if (!scene) return NULL;
+
+            // Point the camera at the requested screen.
+            Camera* camera = createCamera(screen);
+
+            if (request->customCamera)
+                camera->moveTo(request->camera.x, request->camera.y, request->camera.z);
+
+            scene->setCamera(camera);
+
+            resizeFramebuffer(&framebuffer, screen);
+
+            if (renderScene(scene, &framebuffer, request->order, NULL) != 0)
+                return NULL;
+        }
+        catch (const std::bad_alloc&)
+        {
+            // Give the memory of a partially allocated frame back.
+            framebuffer = Framebuffer();
+            return NULL;
+        }
+
+        framesRendered++;
+
+        return &framebuffer;
+    }
+
+    // Get a scene by name, building it on the first use.
+    // Return value:
+    //     Pointer to Scene or NULL if the name is unknown.
+    Scene* loadScene(const std::string& name, Screen screen)
+    {
+        auto entry = scenes.find(name);
+
+        if (entry != scenes.end()) return &entry->second;
+
+        if (name != SCENE_DEFAULT) return NULL;
+
+        return &scenes.emplace(name, createScene(screen)).first->second;
+    }
+
+    // Server thread and its state.
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool running;
+    std::deque<RenderRequest> queue;
+    // Resident scenes and the frame they are rendered to.
+    std::map<std::string, Scene> scenes;
+    Framebuffer framebuffer;
+    std::atomic<int> framesRendered;
+};
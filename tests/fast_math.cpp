@@ -0,0 +1,116 @@
+// Check FAST_MATH helpers against the exact functions.
+// Every helper is compared with a double precision result over normal floats
+// (positive ones, and negative ones for reciprocal and divide) and must stay
+// within the bound documented in fastmath.h.
+// Build (from the repository root):
+//     cl /O2 tests\fast_math.cpp
+//     g++ -O2 tests/fast_math.cpp -o fast_math
+// Usage:
+//     fast_math [stride]   (stride 1 checks every float)
+// Return value:
+//     0 - success.
+//     1 - failure.
+#define FAST_MATH
+#include "../fastmath.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cfloat>
+
+#define FIRST_NORMAL        0x00800000u     // bits of the smallest positive normal float
+#define INFINITY_BITS       0x7F800000u     // bits of positive infinity
+#define RECIPROCAL_LIMIT    0x7E800000u     // bits of 2^126
+
+// Struct that contains the result of checking one helper.
+struct Check
+{
+    const char* name;
+    double bound;
+    double maxError = 0;
+    float worstInput = 0;
+};
+
+// Remember the error of one result.
+void record(Check* check, double error, float x)
+{
+    if (error > check->maxError)
+    {
+        check->maxError = error;
+        check->worstInput = x;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t stride = argc > 1 ? (uint32_t)std::strtoul(argv[1], NULL, 10) : 7;
+
+    if (stride == 0) stride = 1;
+
+    Check checks[] = {
+        { "reciprocal", RECIPROCAL_MAX_ERROR },
+        { "divide", DIVIDE_MAX_ERROR },
+        { "reciprocalSqrt", RECIPROCAL_SQRT_MAX_ERROR },
+        { "squareRoot", SQUARE_ROOT_MAX_ERROR },
+    };
+
+    // Numerators for divide.
+    const float numerators[] = { 1, 3, 0.7f, -12345.678f, 1e-3f };
+
+    for (uint32_t bits = FIRST_NORMAL; bits < INFINITY_BITS; bits += stride)
+    {
+        float x;
+
+        std::memcpy(&x, &bits, sizeof(x));
+
+        double exact = (double)x;
+
+        if (bits < RECIPROCAL_LIMIT)
+        {
+            // Divisors of both signs (Mirror divides by signed dot products).
+            const float divisors[] = { x, -x };
+
+            for (float divisor : divisors)
+            {
+                record(&checks[0], std::fabs(reciprocal(divisor) * (double)divisor - 1), divisor);
+
+                for (float n : numerators)
+                {
+                    double quotient = std::fabs(n / exact);
+
+                    // Skip quotients that are not normal floats.
+                    if (quotient < FLT_MIN || quotient > FLT_MAX) continue;
+
+                    record(&checks[1], std::fabs(divide(n, divisor) * (double)divisor / n - 1), divisor);
+                }
+            }
+        }
+
+        double root = std::sqrt(exact);
+
+        record(&checks[2], std::fabs(reciprocalSqrt(x) * root - 1), x);
+        record(&checks[3], std::fabs(squareRoot(x) / root - 1), x);
+    }
+
+    int failures = 0;
+
+    for (Check& check : checks)
+    {
+        bool passed = check.maxError <= check.bound;
+
+        std::printf("%-15s max error %.3e (bound %.1e, worst input %g) %s\n",
+            check.name, check.maxError, check.bound, check.worstInput, passed ? "ok" : "FAILED");
+
+        if (!passed) failures++;
+    }
+
+    // The estimate of 1 / sqrt(0) is infinity.
+    if (squareRoot(0) != 0)
+    {
+        std::printf("squareRoot(0) is %g\n", squareRoot(0));
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
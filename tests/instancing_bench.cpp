@@ -0,0 +1,147 @@
+// Compare 1M instances of shared geometry against 1M separate objects.
+// Checks that an instance is hit where an equivalent object is hit, then
+// reports heap usage and build time of both scenes.
+// Build (from the repository root):
+//     cl /std:c++20 /O2 /EHsc tests\instancing_bench.cpp render.cpp
+//     g++ -std=c++20 -O2 tests/instancing_bench.cpp render.cpp -o instancing_bench -pthread
+// Return value:
+//     0 - success.
+//     1 - failure.
+#include "../render.h"
+
+#include <cstdlib>
+#include <new>
+
+#define COPIES 1000000
+
+// Bytes requested from the heap and not yet freed.
+static size_t liveBytes = 0;
+
+void* operator new(size_t size)
+{
+    // Keep the size in front of the block to account for frees.
+    size_t* block = (size_t*)std::malloc(size + sizeof(size_t) * 2);
+
+    if (!block) throw std::bad_alloc();
+
+    block[0] = size;
+    liveBytes += size;
+
+    return block + 2;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (!pointer) return;
+
+    size_t* block = (size_t*)pointer - 2;
+
+    liveBytes -= block[0];
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+// Check that instances intersect like the objects they replace.
+// Return value:
+//     0 - success.
+//     1 - failure.
+int checkIntersections()
+{
+    Sphere geometry{ 1, 2, 3, 2, { 0x000000FF } };
+    Instance instance(&geometry, -4, 10, 1, 0.5);
+
+    // Same sphere placed in the scene directly: center * scale + translation.
+    Sphere sphere{ -3.5, 11, 2.5, 1, { 0x000000FF } };
+    int hits = 0;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        Primitive ray(
+            (float)(i % 37) / 9 - 5,
+            10,
+            (float)(i % 23) / 6 - 2
+        );
+
+        float expected = sphere.intersect(&ray);
+        float actual = instance.intersect(&ray);
+
+        if ((expected > 0) != (actual > 0)
+            || (expected > 0 && std::fabs(expected - actual) > 1e-4f * expected))
+        {
+            std::printf("instance mismatch: ray %d, object t %g, instance t %g\n",
+                i, expected, actual);
+            return 1;
+        }
+
+        if (actual > 0) hits++;
+    }
+
+    if (hits == 0)
+    {
+        std::printf("no ray hit the instance\n");
+        return 1;
+    }
+
+    // Zero and negative scales cannot be inverted.
+    Scene scene;
+
+    if (scene.addInstance(&geometry, 0, 0, 0, 0) == 0
+        || scene.addInstance(&geometry, 0, 0, 0, -1) == 0
+        || scene.addInstance(NULL, 0, 0, 0, 1) == 0)
+    {
+        std::printf("invalid instance was accepted\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// Build a scene of copies and report its cost.
+void measure(bool instanced)
+{
+    size_t before = liveBytes;
+    auto start = std::chrono::steady_clock::now();
+
+    Scene scene;
+
+    if (instanced)
+    {
+        Sphere* geometry = new Sphere{ 0, 0, 0, 1, { 0x000000FF } };
+
+        scene.addGeometry(geometry);
+
+        for (int i = 0; i < COPIES; i++)
+            scene.addInstance(geometry, (float)i, 10, 0, 0.5);
+    }
+    else
+    {
+        for (int i = 0; i < COPIES; i++)
+            scene.addObject(new Sphere{ (float)i, 10, 0, 0.5, { 0x000000FF } });
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-10s %d copies: %6.1f MB heap, %6.1f ms build\n",
+        instanced ? "instances" : "objects", COPIES,
+        (liveBytes - before) / 1048576.0, ms);
+
+    scene.clear();
+}
+
+int main()
+{
+    if (checkIntersections() != 0)
+        return 1;
+
+    std::printf("sizeof(Sphere) %zu, sizeof(Instance) %zu\n", sizeof(Sphere), sizeof(Instance));
+
+    measure(false);
+    measure(true);
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Compare pixel traversal orders.
+// Renders the default scene with every order and reports the frame time and,
+// where the platform exposes a hardware counter, cache misses per frame.
+// Build (from the repository root):
+//     cl /std:c++20 /O2 /EHsc tests\order_bench.cpp render.cpp
+//     g++ -std=c++20 -O2 tests/order_bench.cpp render.cpp -o order_bench -pthread
+// The counter is read through perf_event_open on Linux (it may require
+// kernel.perf_event_paranoid <= 2); elsewhere, or when the counter cannot be
+// opened, misses are reported as n/a.
+// Usage:
+//     order_bench [width height [frames]]
+#include "../render.h"
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_WIDTH     640     // default frame size (the one of the window)
+#define BENCH_HEIGHT    480
+
+// Class that counts cache misses of the calling thread.
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+        fd = -1;
+
+#ifdef __linux__
+        perf_event_attr attr = { };
+
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool isAvailable() { return fd >= 0; }
+
+    void start()
+    {
+#ifdef __linux__
+        if (fd < 0) return;
+
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    // Return value:
+    //     Number of misses since start() or -1 if the counter is not available.
+    long long stop()
+    {
+        long long misses = -1;
+
+#ifdef __linux__
+        if (fd < 0) return -1;
+
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(fd, &misses, sizeof(misses)) != sizeof(misses))
+            misses = -1;
+#endif
+
+        return misses;
+    }
+
+private:
+    int fd;
+};
+
+int main(int argc, char** argv)
+{
+    Screen screen = { BENCH_WIDTH, BENCH_HEIGHT };
+    int frames = 10;
+
+    if (argc >= 3)
+    {
+        screen.width = std::atoi(argv[1]);
+        screen.height = std::atoi(argv[2]);
+    }
+
+    if (argc >= 4)
+        frames = std::atoi(argv[3]);
+
+    if (screen.width <= 0 || screen.height <= 0 || frames <= 0)
+    {
+        std::printf("usage: order_bench [width height [frames]]\n");
+        return 1;
+    }
+
+    const int orders[] = { ORDER_SCANLINE, ORDER_MORTON, ORDER_HILBERT };
+    const char* names[] = { "scanline", "morton", "hilbert" };
+
+    Scene scene = createScene(screen);
+    Framebuffer framebuffer;
+    CacheMissCounter counter;
+
+    resizeFramebuffer(&framebuffer, screen);
+
+    std::printf("%dx%d, %d frames per order\n", screen.width, screen.height, frames);
+
+    for (int i = 0; i < 3; i++)
+    {
+        // Warm up caches and the framebuffer.
+        renderScene(&scene, &framebuffer, orders[i], NULL);
+
+        auto start = std::chrono::steady_clock::now();
+
+        counter.start();
+
+        for (int frame = 0; frame < frames; frame++)
+            renderScene(&scene, &framebuffer, orders[i], NULL);
+
+        long long misses = counter.stop();
+
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count() / frames;
+
+        if (misses >= 0)
+            std::printf("%-8s %8.2f ms/frame %12lld cache misses/frame\n", names[i], ms, misses / frames);
+        else
+            std::printf("%-8s %8.2f ms/frame %12s cache misses/frame\n", names[i], ms, "n/a");
+    }
+
+    scene.clear();
+
+    return 0;
+}